@@ -0,0 +1,750 @@
+// benchmark of every ImageEditor filter on synthetic images
+// build: g++ -std=c++11 -O2 -pthread ImageBenchmark.cpp -o ImageBenchmark
+#define IMAGE_EDITOR_NO_MAIN
+#include "ImageEditor.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+/**
+ * times ImageEditor filters over a sweep of image sizes and parameters
+ * every filter call starts from the same synthetic image, the copy is not timed
+ * version: 1.0
+ * date: 2026/10/18
+ */
+class ImageBenchmark
+{
+public:
+    struct Options
+    {
+        int minSize = 256;
+        int maxSize = 4096;
+        int repeat = 5;
+        int threadCount = TileScheduler::defaultWorkerCount();
+        int maxRadius = 64;
+        bool json = false;
+        bool validate = false;
+        std::string filter;
+        std::string outputFile;
+    };
+
+    explicit ImageBenchmark(const Options &options) : m_options(options)
+    {
+    }
+
+    /**
+     * run every case whose name contains the filter on RGB and RGBA images of every size
+     */
+    bool run()
+    {
+        for (int size = m_options.minSize; size <= m_options.maxSize; size *= 2)
+        {
+            for (int depth = 3; depth <= 4; ++depth)
+            {
+                if (!this->runImage(size, depth))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * run validateFixedPoint, validateSimd and validateStream, a csv line per comparison, false when one of them fails
+     */
+    bool validate()
+    {
+        printf("filter,params,width,height,depth,max_diff\n");
+        bool result = this->validateFixedPoint();
+        result = this->validateSimd() && result;
+        result = this->validateStream() && result;
+        return result;
+    }
+
+    bool report()
+    {
+        FILE *file = stdout;
+        if (!m_options.outputFile.empty())
+        {
+            file = ScanlineReader::openFile(m_options.outputFile.c_str(), "w");
+            if (NULL == file)
+            {
+                return false;
+            }
+        }
+
+        if (m_options.json)
+        {
+            this->reportJson(file);
+        }
+        else
+        {
+            this->reportCsv(file);
+        }
+
+        return (stdout == file) || (0 == fclose(file));
+    }
+
+private:
+    struct Case
+    {
+        std::string name;
+        std::string params;
+        std::function<bool(ImageEditor &)> call;
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::string params;
+        int width, height, depth;
+        bool ok;
+        std::vector<double> samples;
+    };
+
+    Options m_options;
+    std::vector<Result> m_results;
+
+    /**
+     * compare BLUR_FIXED_POINT with BLUR_EXACT over every size and radius, false when a byte is off by more than 1
+     */
+    bool validateFixedPoint()
+    {
+        bool result = true;
+        for (int size = m_options.minSize; size <= m_options.maxSize; size *= 2)
+        {
+            for (int depth = 3; depth <= 4; ++depth)
+            {
+                size_t byteCount = (size_t) size * size * depth;
+                unsigned char *m_source_image = (unsigned char *) STBI_MALLOC(byteCount);
+                if (NULL == m_source_image)
+                {
+                    return false;
+                }
+                ImageBenchmark::fillSynthetic(m_source_image, size, size, depth);
+
+                ImageEditor exact, fixed;
+                exact.setThreadCount(m_options.threadCount);
+                fixed.setThreadCount(m_options.threadCount);
+                for (int radius = 1; (radius <= m_options.maxRadius) && result; radius *= 2)
+                {
+                    for (int divisor = 3; divisor >= 1; divisor -= 2)
+                    {
+                        double integrity = (double) radius / divisor;
+                        if (!ImageBenchmark::resetImage(exact, m_source_image, size, depth)
+                            || !ImageBenchmark::resetImage(fixed, m_source_image, size, depth)
+                            || !exact.gaussianBlur(radius, integrity, ImageEditor::BLUR_EXACT)
+                            || !fixed.gaussianBlur(radius, integrity, ImageEditor::BLUR_FIXED_POINT))
+                        {
+                            result = false;
+                            break;
+                        }
+
+                        int maxDiff = ImageBenchmark::maxDifference(exact, fixed);
+                        printf("gaussianBlur,\"radius=%d integrity=%.3f fixed\",%d,%d,%d,%d\n", radius, integrity, size, size, depth, maxDiff);
+                        result = result && (1 >= maxDiff);
+                    }
+                }
+                STBI_FREE(m_source_image);
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * run every point filter at SIMD_NONE and at each vector level up to the detected one on images of depth 1 to 4,
+     * false when a byte differs; the widths are odd so the scalar tails of the vector paths run too
+     */
+    bool validateSimd()
+    {
+        bool result = true;
+        const char *levelNames[] = {"none", "sse41", "avx2"};
+        PixelKernels::SimdLevel detected = PixelKernels::detectSimdLevel();
+        for (int baseSize = m_options.minSize; baseSize <= m_options.maxSize; baseSize *= 2)
+        {
+            int size = baseSize + 3;
+            for (int depth = 1; depth <= 4; ++depth)
+            {
+                size_t byteCount = (size_t) size * size * depth;
+                unsigned char *m_source_image = (unsigned char *) STBI_MALLOC(byteCount);
+                if (NULL == m_source_image)
+                {
+                    return false;
+                }
+                ImageBenchmark::fillSynthetic(m_source_image, size, size, depth);
+
+                std::vector<Case> cases = this->buildSimdCases(depth);
+                ImageEditor scalar, dispatched;
+                scalar.setThreadCount(m_options.threadCount);
+                dispatched.setThreadCount(m_options.threadCount);
+                scalar.setSimdLevel(PixelKernels::SIMD_NONE);
+                for (size_t id = 0; id < cases.size(); ++id)
+                {
+                    const Case &entry = cases[id];
+                    if (std::string::npos == entry.name.find(m_options.filter))
+                    {
+                        continue;
+                    }
+
+                    for (int level = PixelKernels::SIMD_SSE41; level <= detected; ++level)
+                    {
+                        dispatched.setSimdLevel((PixelKernels::SimdLevel) level);
+                        int maxDiff = 256;
+                        if (ImageBenchmark::resetImage(scalar, m_source_image, size, depth)
+                            && ImageBenchmark::resetImage(dispatched, m_source_image, size, depth)
+                            && entry.call(scalar) && entry.call(dispatched))
+                        {
+                            maxDiff = ImageBenchmark::maxDifference(scalar, dispatched);
+                        }
+                        std::string params = (entry.params.empty() ? "" : (entry.params + " ")) + "simd=" + levelNames[level];
+                        printf("%s,\"%s\",%d,%d,%d,%d\n", entry.name.c_str(), params.c_str(), size, size, depth, maxDiff);
+                        result = result && (0 == maxDiff);
+                    }
+                }
+                STBI_FREE(m_source_image);
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * run a chain with blur steps through streamPipeline and compare the file it writes with applyPipeline
+     * on the whole image, for bands thinner and thicker than the halo and each edge policy bands can keep;
+     * false when a byte differs
+     */
+    bool validateStream()
+    {
+        bool result = true;
+        const char *edgeNames[] = {"skip", "clamp", "mirror"};
+        const int bandHeights[] = {1, 5, 16, 200};
+        int size = m_options.minSize + 3;
+
+        ImagePipeline pipeline;
+        pipeline.inverseColor();
+        pipeline.boxBlur(3);
+        pipeline.gaussianChannelBlur(4, 2.0, ImageEditor::CHANNEL_RED | ImageEditor::CHANNEL_BLUE, ImageEditor::BLUR_FIXED_POINT);
+        pipeline.gaussianChannelBlur(3, 1.5, ImageEditor::CHANNEL_ALL, ImageEditor::BLUR_STACKED_BOX);
+        pipeline.fillRectWithColor(size / 4, size / 4, size / 2, 7, 0x20, 0x40, 0x60, 0x80);
+        pipeline.binaryTransform(0x60, 0x80, 0xA0);
+
+        for (int depth = 3; (depth <= 4) && result; ++depth)
+        {
+            size_t byteCount = (size_t) size * size * depth;
+            std::vector<unsigned char> source(byteCount), streamed(byteCount);
+            ImageBenchmark::fillSynthetic(source.data(), size, size, depth);
+
+            ScanlineWriter writer;
+            if (!writer.open("benchmark_validate_in.pam", size, size, depth) || !writer.writeRows(source.data(), size)
+                || !writer.close())
+            {
+                result = false;
+                break;
+            }
+
+            for (int edge = ImageEditor::EDGE_SKIP; edge <= ImageEditor::EDGE_MIRROR; ++edge)
+            {
+                ImageEditor whole;
+                whole.setThreadCount(m_options.threadCount);
+                whole.setEdgePolicy((ImageEditor::EdgePolicy) edge);
+                if (!ImageBenchmark::resetImage(whole, source.data(), size, depth) || !whole.applyPipeline(pipeline))
+                {
+                    result = false;
+                    break;
+                }
+
+                for (size_t id = 0; id < sizeof(bandHeights) / sizeof(bandHeights[0]); ++id)
+                {
+                    ImageEditor streamer;
+                    streamer.setThreadCount(m_options.threadCount);
+                    streamer.setEdgePolicy((ImageEditor::EdgePolicy) edge);
+                    ScanlineReader reader;
+                    int maxDiff = 256;
+                    if (streamer.streamPipeline("benchmark_validate_in.pam", "benchmark_validate_out.pam", pipeline, bandHeights[id])
+                        && reader.open("benchmark_validate_out.pam") && reader.readRows(streamed.data(), size)
+                        && ImageBenchmark::resetImage(streamer, streamed.data(), size, depth))
+                    {
+                        maxDiff = ImageBenchmark::maxDifference(whole, streamer);
+                    }
+                    printf("streamPipeline,\"blur chain band=%d edge=%s\",%d,%d,%d,%d\n", bandHeights[id], edgeNames[edge],
+                        size, size, depth, maxDiff);
+                    result = result && (0 == maxDiff);
+                }
+            }
+        }
+
+        remove("benchmark_validate_in.pam");
+        remove("benchmark_validate_out.pam");
+        return result;
+    }
+
+    /**
+     * the filters whose kernels have vector paths, for an image of depth channels
+     */
+    std::vector<Case> buildSimdCases(int depth)
+    {
+        std::vector<Case> cases;
+        cases.push_back({"inverseColor", "", [](ImageEditor &e) { return e.inverseColor(); }});
+        cases.push_back({"fillRectWithColor", "quarter", [](ImageEditor &e)
+        {
+            return e.fillRectWithColor(e.getWidth() / 4, e.getHeight() / 4, e.getWidth() / 2, e.getHeight() / 2, 0x20, 0x40, 0x60, 0x80);
+        }});
+        if (4 == depth)
+        {
+            cases.push_back({"setAlpha", "", [](ImageEditor &e) { return e.setAlpha(0x80); }});
+        }
+        if (3 <= depth)
+        {
+            cases.push_back({"transformToGray", "float", [](ImageEditor &e) { return e.transformToGray(); }});
+            const char *grayNames[] = {"shift7", "integer100", "bt601", "bt709"};
+            for (int mode = PixelKernels::GRAY_SHIFT7; mode <= PixelKernels::GRAY_BT709; ++mode)
+            {
+                cases.push_back({"transformToGray", grayNames[mode], [mode](ImageEditor &e)
+                {
+                    return e.transformToGray((PixelKernels::GrayMode) mode);
+                }});
+                cases.push_back({"transformToGrayPlane", grayNames[mode], [mode](ImageEditor &e)
+                {
+                    return e.transformToGrayPlane((PixelKernels::GrayMode) mode);
+                }});
+            }
+        }
+        cases.push_back({"decayColor", "coeff=0.5", [](ImageEditor &e) { return e.decayColor(0.5f); }});
+        cases.push_back({"decayRGB", "coeff=0.9/0.5/0.2", [](ImageEditor &e) { return e.decayRGB(0.9f, 0.5f, 0.2f); }});
+        cases.push_back({"binaryTransform", "threshold=96/128/160", [](ImageEditor &e) { return e.binaryTransform(96, 128, 160); }});
+
+        ColorLookupTable table;
+        table.inverseColor();
+        table.decayColor(0.5f);
+        cases.push_back({"applyLookupTable", "inverse+decay", [table](ImageEditor &e) { return e.applyLookupTable(table); }});
+        ImagePipeline pipeline;
+        pipeline.inverseColor();
+        pipeline.decayRGB(0.9f, 0.5f, 0.2f);
+        pipeline.binaryTransform(0x40, 0x60, 0x80);
+        cases.push_back({"applyPipeline", "inverse+decay+threshold", [pipeline](ImageEditor &e) { return e.applyPipeline(pipeline); }});
+        cases.push_back({"gaussianBlur", "radius=4 integrity=4.000 fixed", [](ImageEditor &e)
+        {
+            return e.gaussianBlur(4, 4.0, ImageEditor::BLUR_FIXED_POINT);
+        }});
+        return cases;
+    }
+
+    /**
+     * largest difference of a byte of two images, 256 when their sizes differ
+     */
+    static int maxDifference(ImageEditor &first, ImageEditor &second)
+    {
+        if ((first.getWidth() != second.getWidth()) || (first.getHeight() != second.getHeight())
+            || (first.getDepth() != second.getDepth()))
+        {
+            return 256;
+        }
+
+        int maxDiff = 0;
+        for (int y = 0; y < first.getHeight(); ++y)
+        {
+            const unsigned char *firstRow = first.m_image_data + (size_t) y * first.getStride();
+            const unsigned char *secondRow = second.m_image_data + (size_t) y * second.getStride();
+            for (int x = 0; x < first.getWidth() * first.getDepth(); ++x)
+            {
+                int diff = abs((int) firstRow[x] - (int) secondRow[x]);
+                maxDiff = (diff > maxDiff) ? diff : maxDiff;
+            }
+        }
+        return maxDiff;
+    }
+
+    /**
+     * gradient with noise so thresholds and blurs see varying data
+     */
+    static void fillSynthetic(unsigned char *data, int width, int height, int depth)
+    {
+        unsigned int state = 0x9E3779B9u;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                unsigned char *pixel = data + ((size_t) y * width + x) * depth;
+                unsigned char color[4];
+                color[0] = (unsigned char) ((x * 255 / width + (state & 0x3F)) & 0xFF);
+                color[1] = (unsigned char) ((y * 255 / height + ((state >> 8) & 0x3F)) & 0xFF);
+                color[2] = (unsigned char) (((x + y) * 127 / width + ((state >> 16) & 0x3F)) & 0xFF);
+                color[3] = (unsigned char) (state >> 24);
+                memcpy(pixel, color, depth);
+            }
+        }
+    }
+
+    static std::string format(const char *pattern, double a, double b = 0.0, double c = 0.0)
+    {
+        char text[128];
+        snprintf(text, sizeof(text), pattern, a, b, c);
+        return text;
+    }
+
+    /**
+     * every public ImageEditor filter with the parameters swept for an image of size * size
+     */
+    std::vector<Case> buildCases(int size, int depth)
+    {
+        std::vector<Case> cases;
+        std::vector<int> radii;
+        for (int radius = 1; radius <= m_options.maxRadius; radius *= 2)
+        {
+            radii.push_back(radius);
+        }
+
+        cases.push_back({"inverseColor", "", [](ImageEditor &e) { return e.inverseColor(); }});
+        cases.push_back({"fillAllWithColor", "", [](ImageEditor &e) { return e.fillAllWithColor(0x20, 0x40, 0x60, 0x80); }});
+        cases.push_back({"fillRectWithColor", "quarter", [size](ImageEditor &e)
+        {
+            return e.fillRectWithColor(size / 4, size / 4, size / 2, size / 2, 0x20, 0x40, 0x60, 0x80);
+        }});
+        if (4 == depth)
+        {
+            cases.push_back({"setAlpha", "", [](ImageEditor &e) { return e.setAlpha(0x80); }});
+        }
+        cases.push_back({"transformToGray", "float", [](ImageEditor &e) { return e.transformToGray(); }});
+        const char *grayNames[] = {"shift7", "integer100", "bt601", "bt709"};
+        for (int mode = PixelKernels::GRAY_SHIFT7; mode <= PixelKernels::GRAY_BT709; ++mode)
+        {
+            cases.push_back({"transformToGray", grayNames[mode], [mode](ImageEditor &e)
+            {
+                return e.transformToGray((PixelKernels::GrayMode) mode);
+            }});
+            cases.push_back({"transformToGrayPlane", grayNames[mode], [mode](ImageEditor &e)
+            {
+                return e.transformToGrayPlane((PixelKernels::GrayMode) mode);
+            }});
+        }
+        cases.push_back({"decayColor", "coeff=0.5", [](ImageEditor &e) { return e.decayColor(0.5f); }});
+        cases.push_back({"decayRGB", "coeff=0.9/0.5/0.2", [](ImageEditor &e) { return e.decayRGB(0.9f, 0.5f, 0.2f); }});
+        for (int threshold = 0x40; threshold <= 0xC0; threshold += 0x40)
+        {
+            cases.push_back({"binaryTransform", format("threshold=%.0f", threshold), [threshold](ImageEditor &e)
+            {
+                return e.binaryTransform(threshold, threshold, threshold);
+            }});
+        }
+
+        for (size_t id = 0; id < radii.size(); ++id)
+        {
+            int radius = radii[id];
+            cases.push_back({"verticalBlur", format("length=%.0f", radius), [radius](ImageEditor &e) { return e.verticalBlur(radius); }});
+            cases.push_back({"horizontalBlur", format("length=%.0f", radius), [radius](ImageEditor &e) { return e.horizontalBlur(radius); }});
+            cases.push_back({"boxBlur", format("radius=%.0f", radius), [radius](ImageEditor &e) { return e.boxBlur(radius); }});
+            for (int divisor = 3; divisor >= 1; divisor -= 2)
+            {
+                double integrity = (double) radius / divisor;
+                std::string params = format("radius=%.0f integrity=%.3f", radius, integrity);
+                cases.push_back({"gaussianBlur", params, [radius, integrity](ImageEditor &e)
+                {
+                    return e.gaussianBlur(radius, integrity);
+                }});
+                cases.push_back({"gaussianBlur", params + " stacked", [radius, integrity](ImageEditor &e)
+                {
+                    return e.gaussianBlur(radius, integrity, ImageEditor::BLUR_STACKED_BOX);
+                }});
+                cases.push_back({"gaussianBlur", params + " fixed", [radius, integrity](ImageEditor &e)
+                {
+                    return e.gaussianBlur(radius, integrity, ImageEditor::BLUR_FIXED_POINT);
+                }});
+                cases.push_back({"gaussianChannelBlur", params + " red|blue", [radius, integrity](ImageEditor &e)
+                {
+                    return e.gaussianChannelBlur(radius, integrity, ImageEditor::CHANNEL_RED | ImageEditor::CHANNEL_BLUE);
+                }});
+                cases.push_back({"gaussianRedBlur", params, [radius, integrity](ImageEditor &e) { return e.gaussianRedBlur(radius, integrity); }});
+                cases.push_back({"gaussianGreenBlur", params, [radius, integrity](ImageEditor &e) { return e.gaussianGreenBlur(radius, integrity); }});
+                cases.push_back({"gaussianBlueBlur", params, [radius, integrity](ImageEditor &e) { return e.gaussianBlueBlur(radius, integrity); }});
+                // counts the split into planes and the merge back, as a single filter on a planar load would pay them
+                cases.push_back({"gaussianRedBlur", params + " planar", [radius, integrity](ImageEditor &e)
+                {
+                    return e.setPixelLayout(ImageObject::LAYOUT_PLANAR) && e.gaussianRedBlur(radius, integrity)
+                        && e.setPixelLayout(ImageObject::LAYOUT_INTERLEAVED);
+                }});
+                // the 2D reference costs (2r + 1)^2 per pixel, keep it to what finishes in seconds
+                if ((4 >= radius) && (1024 >= size))
+                {
+                    cases.push_back({"gaussianBlurReference", params, [radius, integrity](ImageEditor &e)
+                    {
+                        return e.gaussianBlurReference(radius, integrity);
+                    }});
+                }
+            }
+        }
+
+        // the same blur on the centered quarter through a view, its cost should be a quarter of the whole image
+        int viewThreads = m_options.threadCount;
+        cases.push_back({"gaussianBlur", "radius=8 integrity=8.000 fixed view=quarter", [size, viewThreads](ImageEditor &e)
+        {
+            ImageObject::View view;
+            ImageEditor region;
+            region.setThreadCount(viewThreads);
+            return e.getView(size / 4, size / 4, size / 2, size / 2, &view) && region.attachView(view)
+                && region.gaussianBlur(8, 8.0, ImageEditor::BLUR_FIXED_POINT);
+        }});
+
+        // the pyramid block is kept between runs, as it would be for a stream of uploads
+        std::shared_ptr<ImagePyramid> pyramid = std::make_shared<ImagePyramid>();
+        cases.push_back({"buildPyramid", "levels=all", [pyramid](ImageEditor &e) { return e.buildPyramid(pyramid.get(), 0); }});
+
+        ImagePipeline pipeline;
+        pipeline.transformToGray();
+        pipeline.binaryTransform(0x80, 0x80, 0x80);
+        cases.push_back({"applyPipeline", "gray+threshold", [pipeline](ImageEditor &e) { return e.applyPipeline(pipeline); }});
+        ColorLookupTable table;
+        table.inverseColor();
+        table.decayColor(0.5f);
+        table.binaryTransform(0x40, 0x40, 0x40);
+        cases.push_back({"applyLookupTable", "inverse+decay+threshold", [table](ImageEditor &e) { return e.applyLookupTable(table); }});
+
+        int threadCount = m_options.threadCount;
+        cases.push_back({"streamPipeline", "gray+threshold band=256", [pipeline, threadCount](ImageEditor &)
+        {
+            ImageEditor streamer;
+            streamer.setThreadCount(threadCount);
+            return streamer.streamPipeline("benchmark_stream_in.pam", "benchmark_stream_out.pam", pipeline, 256);
+        }});
+
+        return cases;
+    }
+
+    bool runImage(int size, int depth)
+    {
+        size_t byteCount = (size_t) size * size * depth;
+        unsigned char *m_source_image = (unsigned char *) STBI_MALLOC(byteCount);
+        if (NULL == m_source_image)
+        {
+            fprintf(stderr, "no memory for %dx%dx%d\n", size, size, depth);
+            return false;
+        }
+        ImageBenchmark::fillSynthetic(m_source_image, size, size, depth);
+
+        std::vector<Case> cases = this->buildCases(size, depth);
+        bool streamed = false;
+        ImageEditor editor;
+        editor.setThreadCount(m_options.threadCount);
+        for (size_t id = 0; id < cases.size(); ++id)
+        {
+            const Case &entry = cases[id];
+            if (std::string::npos == entry.name.find(m_options.filter))
+            {
+                continue;
+            }
+
+            if (("streamPipeline" == entry.name) && !streamed)
+            {
+                ScanlineWriter writer;
+                streamed = writer.open("benchmark_stream_in.pam", size, size, depth)
+                    && writer.writeRows(m_source_image, size) && writer.close();
+            }
+
+            fprintf(stderr, "%s %s %dx%dx%d\n", entry.name.c_str(), entry.params.c_str(), size, size, depth);
+            Result result = {entry.name, entry.params, size, size, depth, true, std::vector<double>()};
+            // the first call warms caches and the tile scheduler and is not counted
+            for (int run = 0; (run <= m_options.repeat) && result.ok; ++run)
+            {
+                if (!ImageBenchmark::resetImage(editor, m_source_image, size, depth))
+                {
+                    STBI_FREE(m_source_image);
+                    return false;
+                }
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                result.ok = entry.call(editor);
+                std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+                if (0 < run)
+                {
+                    result.samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+                }
+            }
+            m_results.push_back(result);
+        }
+
+        if (streamed)
+        {
+            remove("benchmark_stream_in.pam");
+            remove("benchmark_stream_out.pam");
+        }
+
+        STBI_FREE(m_source_image);
+        return true;
+    }
+
+    /**
+     * load the synthetic image into editor, reallocating when a filter changed its depth
+     */
+    static bool resetImage(ImageEditor &editor, const unsigned char *source, int size, int depth)
+    {
+        if (editor.isInitized() && ((editor.m_width != size) || (editor.m_height != size) || (editor.m_depth != depth)))
+        {
+            editor.releasePngImage();
+        }
+
+        if (!editor.isInitized() && !editor.createImage(size, size, depth))
+        {
+            return false;
+        }
+
+        for (int y = 0; y < size; ++y)
+        {
+            memcpy(editor.m_image_data + (size_t) y * editor.getStride(), source + (size_t) y * size * depth, (size_t) size * depth);
+        }
+        return true;
+    }
+
+    /**
+     * nearest rank percentile of sorted samples, in milliseconds
+     */
+    static double percentile(const std::vector<double> &sorted, double rank)
+    {
+        if (sorted.empty())
+        {
+            return 0.0f;
+        }
+
+        size_t id = (size_t) ceil(rank / 100.0f * sorted.size());
+        id = (0 < id) ? (id - 1) : 0;
+        return sorted[(id < sorted.size()) ? id : (sorted.size() - 1)] / 1e6;
+    }
+
+    /**
+     * ns per pixel and GB/s of the median call, the bandwidth counts one read and one write of the image
+     */
+    static void summarize(const Result &result, std::vector<double> &sorted, double &nsPerPixel, double &gbPerSecond)
+    {
+        sorted = result.samples;
+        std::sort(sorted.begin(), sorted.end());
+        double pixels = (double) result.width * result.height;
+        double median = ImageBenchmark::percentile(sorted, 50.0f) * 1e6;
+        nsPerPixel = (0.0f < pixels) ? (median / pixels) : 0.0f;
+        gbPerSecond = (0.0f < median) ? (2.0f * pixels * result.depth / median) : 0.0f;
+    }
+
+    void reportCsv(FILE *file)
+    {
+        fprintf(file, "filter,params,width,height,depth,threads,ok,repeat,ns_per_pixel,gb_per_s,min_ms,p50_ms,p90_ms,p99_ms,max_ms\n");
+        for (size_t id = 0; id < m_results.size(); ++id)
+        {
+            const Result &result = m_results[id];
+            std::vector<double> sorted;
+            double nsPerPixel, gbPerSecond;
+            ImageBenchmark::summarize(result, sorted, nsPerPixel, gbPerSecond);
+            fprintf(file, "%s,\"%s\",%d,%d,%d,%d,%d,%d,%.4f,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                result.name.c_str(), result.params.c_str(), result.width, result.height, result.depth,
+                m_options.threadCount, result.ok ? 1 : 0, (int) sorted.size(), nsPerPixel, gbPerSecond,
+                ImageBenchmark::percentile(sorted, 0.0f), ImageBenchmark::percentile(sorted, 50.0f),
+                ImageBenchmark::percentile(sorted, 90.0f), ImageBenchmark::percentile(sorted, 99.0f),
+                ImageBenchmark::percentile(sorted, 100.0f));
+        }
+    }
+
+    void reportJson(FILE *file)
+    {
+        fprintf(file, "[\n");
+        for (size_t id = 0; id < m_results.size(); ++id)
+        {
+            const Result &result = m_results[id];
+            std::vector<double> sorted;
+            double nsPerPixel, gbPerSecond;
+            ImageBenchmark::summarize(result, sorted, nsPerPixel, gbPerSecond);
+            fprintf(file, "  {\"filter\": \"%s\", \"params\": \"%s\", \"width\": %d, \"height\": %d, \"depth\": %d, "
+                "\"threads\": %d, \"ok\": %s, \"repeat\": %d, \"ns_per_pixel\": %.4f, \"gb_per_s\": %.3f, "
+                "\"min_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+                result.name.c_str(), result.params.c_str(), result.width, result.height, result.depth,
+                m_options.threadCount, result.ok ? "true" : "false", (int) sorted.size(), nsPerPixel, gbPerSecond,
+                ImageBenchmark::percentile(sorted, 0.0f), ImageBenchmark::percentile(sorted, 50.0f),
+                ImageBenchmark::percentile(sorted, 90.0f), ImageBenchmark::percentile(sorted, 99.0f),
+                ImageBenchmark::percentile(sorted, 100.0f), ((id + 1) < m_results.size()) ? "," : "");
+        }
+        fprintf(file, "]\n");
+    }
+};
+
+static void printUsage()
+{
+    printf("usage: ImageBenchmark [--json | --validate] [--out file] [--filter name] [--min-size n] [--max-size n]\n"
+        "                      [--max-radius n] [--repeat n] [--threads n]\n"
+        "sizes double from min-size to max-size (256 to 4096 by default, up to 16384), radii double from 1 to max-radius\n"
+        "--validate checks the fixed point gaussian against the double one and the SIMD filters against scalar\n"
+        "           on depth 1 to 4 and streamPipeline against applyPipeline instead of timing\n");
+}
+
+int main(int argc, char **argv)
+{
+    ImageBenchmark::Options options;
+    for (int id = 1; id < argc; ++id)
+    {
+        std::string arg = argv[id];
+        bool hasValue = (id + 1) < argc;
+        if ("--json" == arg)
+        {
+            options.json = true;
+        }
+        else if ("--validate" == arg)
+        {
+            options.validate = true;
+        }
+        else if (("--out" == arg) && hasValue)
+        {
+            options.outputFile = argv[++id];
+        }
+        else if (("--filter" == arg) && hasValue)
+        {
+            options.filter = argv[++id];
+        }
+        else if (("--min-size" == arg) && hasValue)
+        {
+            options.minSize = atoi(argv[++id]);
+        }
+        else if (("--max-size" == arg) && hasValue)
+        {
+            options.maxSize = atoi(argv[++id]);
+        }
+        else if (("--max-radius" == arg) && hasValue)
+        {
+            options.maxRadius = atoi(argv[++id]);
+        }
+        else if (("--repeat" == arg) && hasValue)
+        {
+            options.repeat = atoi(argv[++id]);
+        }
+        else if (("--threads" == arg) && hasValue)
+        {
+            options.threadCount = atoi(argv[++id]);
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if ((0 >= options.minSize) || (options.minSize > options.maxSize) || (0 >= options.repeat)
+        || (0 >= options.threadCount) || (0 >= options.maxRadius))
+    {
+        printUsage();
+        return 1;
+    }
+
+    ImageBenchmark benchmark(options);
+    if (options.validate)
+    {
+        return benchmark.validate() ? 0 : 1;
+    }
+
+    if (!benchmark.run() || !benchmark.report())
+    {
+        fprintf(stderr, "benchmark failed\n");
+        return 1;
+    }
+
+    return 0;
+}